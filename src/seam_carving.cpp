@@ -6,6 +6,26 @@
 #include <string>
 #include <opencv2/opencv.hpp>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
 //const int MOD = 1e9 + 7;
@@ -32,6 +52,17 @@ public:
         data = new unsigned char[h * w * d];
     }
 
+    // deep copy, so a decoded image can be carved more than once
+    Cube(const Cube& other) : Cube(other.height, other.width, other.depth) {
+        std::memcpy(data, other.data, height * width * depth);
+    }
+    Cube& operator=(const Cube&) = delete;
+
+    // move: take over the buffer, no copy
+    Cube(Cube&& other) noexcept : data(other.data), height(other.height), width(other.width), depth(other.depth) {
+        other.data = nullptr;
+    }
+
     // free the heap memory when the object is deleted.
     ~Cube() { delete[] data; }
 
@@ -66,6 +97,17 @@ public:
         data = new double[h * w];
     }
 
+    // deep copy
+    Energy(const Energy& other) : Energy(other.height, other.width) {
+        std::memcpy(data, other.data, height * width * sizeof(double));
+    }
+    Energy& operator=(const Energy&) = delete;
+
+    // move: take over the buffer, no copy
+    Energy(Energy&& other) noexcept : data(other.data), height(other.height), width(other.width) {
+        other.data = nullptr;
+    }
+
     // free the heap memory when the object is deleted.
     ~Energy() { delete[] data; }
 
@@ -120,6 +162,113 @@ Energy dual_gradient_energy(const Cube& cube, size_t height, size_t width, size_
 
 
 
+//====================================================================================================
+//                    PROTECTED REGIONS (FACE / OBJECT DETECTION)
+//====================================================================================================
+
+// Cascades shipped with the OpenCV install; CMake points this at the detected directory.
+#ifndef SEAM_CASCADE_DIR
+#define SEAM_CASCADE_DIR "/usr/share/opencv4"
+#endif
+
+const string kDefaultCascade = string(SEAM_CASCADE_DIR) + "/haarcascades/haarcascade_frontalface_default.xml";
+
+// Added to every protected pixel. Larger than any unprotected seam can cost
+// (height * 2 * 3 * 255^2 for images up to ~2.5M rows), so seams route around detections.
+constexpr double kProtectionBias = 1e12;
+
+// Runs a loaded Haar/LBP cascade against a downscaled grayscale copy of img.
+// Returned rectangles are in full-resolution coordinates, padded by 10% and clipped.
+std::vector<cv::Rect> detect_protected_regions(const cv::Mat& img, cv::CascadeClassifier& cascade) {
+    const int kMaxSide = 480;
+    double scale = std::min(1.0, double(kMaxSide) / std::max(img.cols, img.rows));
+    cv::Mat small, gray;
+    if (scale < 1.0)
+        cv::resize(img, small, cv::Size(int(img.cols * scale), int(img.rows * scale)), 0, 0, cv::INTER_AREA);
+    else
+        small = img;
+    cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    cv::equalizeHist(gray, gray);
+
+    std::vector<cv::Rect> found;
+    cascade.detectMultiScale(gray, found, 1.1, 4, 0, cv::Size(24, 24));
+
+    std::vector<cv::Rect> regions;
+    for (const cv::Rect& r : found) {
+        int pad_x = r.width / 10, pad_y = r.height / 10;
+        int x0 = std::max(0, int((r.x - pad_x) / scale));
+        int y0 = std::max(0, int((r.y - pad_y) / scale));
+        int x1 = std::min(img.cols, int((r.x + r.width + pad_x) / scale) + 1);
+        int y1 = std::min(img.rows, int((r.y + r.height + pad_y) / scale) + 1);
+        if (x1 > x0 && y1 > y0) {
+            cv::Rect full;
+            full.x = x0; full.y = y0; full.width = x1 - x0; full.height = y1 - y0;
+            regions.push_back(full);
+        }
+    }
+    return regions;
+}
+
+// Loads the cascade and runs detect_protected_regions on a worker thread, so it overlaps
+// with decoding and the first dual_gradient_energy pass of a single image.
+// A cascade that fails to load yields no detections (with a warning), not an error.
+std::future<std::vector<cv::Rect>> detect_protected_regions_async(cv::Mat img, const string& cascade_path) {
+    return std::async(std::launch::async, [img, cascade_path] {
+        cv::CascadeClassifier cascade;
+        if (!cascade.load(cascade_path)) {
+            std::cerr << "Could not load cascade " << cascade_path << ", no regions protected\n";
+            return std::vector<cv::Rect>();
+        }
+        return detect_protected_regions(img, cascade);
+    });
+}
+
+// Bias map for the uncarved image; carve it with the same seams as the Cube
+// (delete_*_seam_energy) so it stays aligned.
+Energy protection_bias(const std::vector<cv::Rect>& regions, size_t height, size_t width) {
+    Energy bias(height, width);
+    for (size_t y = 0; y < height; ++y)
+        for (size_t x = 0; x < width; ++x)
+            bias(y, x) = 0.0;
+
+    for (const cv::Rect& r : regions)
+        for (size_t y = (size_t)r.y; y < (size_t)(r.y + r.height) && y < height; ++y)
+            for (size_t x = (size_t)r.x; x < (size_t)(r.x + r.width) && x < width; ++x)
+                bias(y, x) = kProtectionBias;
+    return bias;
+}
+
+void add_bias(Energy& energy, const Energy& bias, size_t height, size_t width) {
+    for (size_t y = 0; y < height; ++y)
+        for (size_t x = 0; x < width; ++x)
+            energy(y, x) += bias(y, x);
+}
+
+// Protects every non-zero pixel of a single-channel mask; a mask of a different size is
+// scaled to the image first.
+void add_mask_bias(Energy& bias, const cv::Mat& mask, size_t height, size_t width) {
+    cv::Mat scaled = mask;
+    if ((size_t)mask.rows != height || (size_t)mask.cols != width)
+        cv::resize(mask, scaled, cv::Size((int)width, (int)height), 0, 0, cv::INTER_AREA);
+
+    for (size_t y = 0; y < height; ++y) {
+        const unsigned char* row = scaled.ptr<unsigned char>((int)y);
+        for (size_t x = 0; x < width; ++x)
+            if (row[x]) bias(y, x) = kProtectionBias;
+    }
+}
+
+// dual_gradient_energy plus the protection bias, if any
+Energy protected_energy(const Cube& cube, const Energy* protection, size_t height, size_t width) {
+    Energy energy = dual_gradient_energy(cube, height, width, 3);
+    if (protection) add_bias(energy, *protection, height, width);
+    return energy;
+}
+
+
+
+
+
 //====================================================================================================
 //                    FUNCTION TO CALCULATE VERTICAL SEAM
 //====================================================================================================
@@ -297,6 +446,17 @@ cv::Mat cubeToMat(const Cube& cube, size_t height, size_t width) {
     return img;
 }
 
+void matToCube(const cv::Mat& img, Cube& cube) {
+    for (size_t y = 0; y < (size_t)img.rows; ++y) {
+        const cv::Vec3b* row = img.ptr<cv::Vec3b>((int)y);
+        for (size_t x = 0; x < (size_t)img.cols; ++x) {
+            cube(y, x, 0) = row[x][0]; // B
+            cube(y, x, 1) = row[x][1]; // G
+            cube(y, x, 2) = row[x][2]; // R
+        }
+    }
+}
+
 
 
 
@@ -335,6 +495,346 @@ void delete_horizontal_seam(Cube &cube, const size_t* seam, size_t &height, size
     height -= 1; // image is now 1 row smaller
 }
 
+// Keep a carved energy map aligned with its Cube. Dimensions are passed by value and are
+// the ones before the seam is removed: call these before delete_*_seam(cube, ...), which
+// is the one that shrinks them.
+void delete_vertical_seam_energy(Energy &energy, const size_t* seam, size_t height, size_t width) {
+    for (size_t y = 0; y < height; ++y) {
+        size_t x = seam[y];
+        if (x >= width) continue; // safety
+        for (size_t j = x; j < width - 1; ++j)
+            energy(y, j) = energy(y, j + 1);
+    }
+}
+
+void delete_horizontal_seam_energy(Energy &energy, const size_t* seam, size_t height, size_t width) {
+    for (size_t x = 0; x < width; ++x) {
+        size_t y = seam[x];
+        if (y >= height) continue; // safety
+        for (size_t i = y; i < height - 1; ++i)
+            energy(i, x) = energy(i + 1, x);
+    }
+}
+
+
+
+
+
+//====================================================================================================
+//                    FUNCTION TO CARVE WITHOUT DISPLAY
+//====================================================================================================
+
+// Same seam order as main(): all vertical seams first, then all horizontal seams.
+// initial_energy, if given, must be the energy of the uncarved cube (protection bias
+// included); it is used for the first seam instead of recomputing it.
+// protection, if given, is the bias map from protection_bias(); it is carved along with the cube.
+// cancel, if given, is checked between seams; once set, carving stops where it is.
+void carve_exact(Cube &cube, const Energy* initial_energy, Energy* protection,
+                 size_t &height, size_t &width, size_t new_height, size_t new_width,
+                 const std::atomic<bool>* cancel = nullptr) {
+    auto cancelled = [&] { return cancel && cancel->load(std::memory_order_relaxed); };
+
+    while (width > new_width && width >= 2 && !cancelled()) {
+        size_t* seam;
+        if (initial_energy) {
+            seam = find_vertical_seam(*initial_energy, height, width);
+            initial_energy = nullptr;
+        } else {
+            Energy energy = protected_energy(cube, protection, height, width);
+            seam = find_vertical_seam(energy, height, width);
+        }
+        if (protection) delete_vertical_seam_energy(*protection, seam, height, width);
+        delete_vertical_seam(cube, seam, height, width);
+        delete[] seam;
+    }
+
+    while (height > new_height && height >= 2 && !cancelled()) {
+        size_t* seam;
+        if (initial_energy) {
+            seam = find_horizontal_seam(*initial_energy, height, width);
+            initial_energy = nullptr;
+        } else {
+            Energy energy = protected_energy(cube, protection, height, width);
+            seam = find_horizontal_seam(energy, height, width);
+        }
+        if (protection) delete_horizontal_seam_energy(*protection, seam, height, width);
+        delete_horizontal_seam(cube, seam, height, width);
+        delete[] seam;
+    }
+}
+
+void carve_generic(Cube &cube, size_t &height, size_t &width, size_t new_height, size_t new_width) {
+    carve_exact(cube, nullptr, nullptr, height, width, new_height, new_width);
+}
+
+
+
+
+
+//====================================================================================================
+//                    FIXED-SIZE THUMBNAIL FAST PATH
+//====================================================================================================
+
+// Images up to kThumbMax x kThumbMax skip the heap-allocated Cube/Energy/dist/back buffers.
+// - pixels use a compile-time stride and live in thread-local storage (~192 KB, L2 resident)
+// - the energy map is never materialised: each row is computed right before the DP consumes it
+// - only two DP rows are kept; backtracking stores a 1-byte step (-1, 0, +1) per pixel
+// Energies are exact integers (<= 2 * 3 * 255^2 per pixel), so uint32_t sums give the same
+// seams as the double-based generic path, including tie-breaking.
+// Horizontal seams are carved as vertical seams of the transposed image.
+
+constexpr size_t kThumbMax = 256;
+
+struct ThumbBuffers {
+    unsigned char pixels[kThumbMax * kThumbMax * 3];
+    int8_t        back[kThumbMax * kThumbMax];
+    uint32_t      dist[2][kThumbMax];
+    uint32_t      energy_row[kThumbMax];
+    size_t        seam[kThumbMax];
+};
+
+static thread_local ThumbBuffers thumb;
+
+bool fits_thumbnail(size_t height, size_t width) {
+    return height <= kThumbMax && width <= kThumbMax;
+}
+
+static inline unsigned char* thumb_pixel(size_t y, size_t x) {
+    return thumb.pixels + (y * kThumbMax + x) * 3;
+}
+
+static inline uint32_t thumb_gradient(const unsigned char* a, const unsigned char* b) {
+    int d0 = int(a[0]) - int(b[0]);
+    int d1 = int(a[1]) - int(b[1]);
+    int d2 = int(a[2]) - int(b[2]);
+    return uint32_t(d0 * d0 + d1 * d1 + d2 * d2);
+}
+
+// energy of row y, same wraparound rules as dual_gradient_energy
+static void thumb_energy_row(size_t y, size_t height, size_t width, uint32_t* out) {
+    const unsigned char* row  = thumb_pixel(y, 0);
+    const unsigned char* up   = thumb_pixel((y + height - 1) % height, 0);
+    const unsigned char* down = thumb_pixel((y + 1) % height, 0);
+
+    // wrapped borders
+    auto border = [&](size_t x) {
+        size_t left = (x + width - 1) % width;
+        size_t right = (x + 1) % width;
+        return thumb_gradient(row + right * 3, row + left * 3) + thumb_gradient(down + x * 3, up + x * 3);
+    };
+    out[0] = border(0);
+    if (width > 1) out[width - 1] = border(width - 1);
+
+    // interior: no modulo, no branches
+#pragma GCC unroll 8
+    for (size_t x = 1; x + 1 < width; ++x) {
+        out[x] = thumb_gradient(row + (x + 1) * 3, row + (x - 1) * 3)
+               + thumb_gradient(down + x * 3, up + x * 3);
+    }
+}
+
+// one DP row; same predecessor preference as find_vertical_seam (x, then x-1, then x+1)
+static void thumb_dp_row(const uint32_t* prev, const uint32_t* energy, size_t width,
+                         uint32_t* cur, int8_t* back) {
+    auto relax = [&](size_t x, bool has_left, bool has_right) {
+        uint32_t best = prev[x];
+        int8_t step = 0;
+        if (has_left && prev[x - 1] < best)  { best = prev[x - 1]; step = -1; }
+        if (has_right && prev[x + 1] < best) { best = prev[x + 1]; step = 1; }
+        cur[x] = best + energy[x];
+        back[x] = step;
+    };
+    relax(0, false, width > 1);
+    if (width > 1) relax(width - 1, true, false);
+
+#pragma GCC unroll 8
+    for (size_t x = 1; x + 1 < width; ++x) relax(x, true, true);
+}
+
+static void thumb_carve_vertical(size_t height, size_t &width, size_t new_width) {
+    while (width > new_width && width >= 2) {
+        uint32_t* prev = thumb.dist[0];
+        uint32_t* cur  = thumb.dist[1];
+
+        thumb_energy_row(0, height, width, prev);
+        for (size_t y = 1; y < height; ++y) {
+            thumb_energy_row(y, height, width, thumb.energy_row);
+            thumb_dp_row(prev, thumb.energy_row, width, cur, thumb.back + y * kThumbMax);
+            std::swap(prev, cur);
+        }
+
+        // min end in last row, then backtrack
+        size_t best_col = 0;
+        for (size_t x = 1; x < width; ++x)
+            if (prev[x] < prev[best_col]) best_col = x;
+
+        thumb.seam[height - 1] = best_col;
+        for (size_t y = height - 1; y > 0; --y)
+            thumb.seam[y - 1] = size_t(ptrdiff_t(thumb.seam[y]) + thumb.back[y * kThumbMax + thumb.seam[y]]);
+
+        // shift pixels after the seam left by 1
+        for (size_t y = 0; y < height; ++y) {
+            size_t x = thumb.seam[y];
+            std::memmove(thumb_pixel(y, x), thumb_pixel(y, x + 1), (width - 1 - x) * 3);
+        }
+        width -= 1;
+    }
+}
+
+// in-place transpose of the leading n x n square
+static void thumb_transpose(size_t n) {
+    for (size_t y = 0; y < n; ++y)
+        for (size_t x = y + 1; x < n; ++x) {
+            unsigned char* a = thumb_pixel(y, x);
+            unsigned char* b = thumb_pixel(x, y);
+            std::swap(a[0], b[0]);
+            std::swap(a[1], b[1]);
+            std::swap(a[2], b[2]);
+        }
+}
+
+// Drop-in replacement for carve_generic on small images; returns false if the image does not fit.
+bool carve_thumbnail(Cube &cube, size_t &height, size_t &width, size_t new_height, size_t new_width) {
+    if (!fits_thumbnail(height, width)) return false;
+
+    for (size_t y = 0; y < height; ++y)
+        for (size_t x = 0; x < width; ++x) {
+            unsigned char* p = thumb_pixel(y, x);
+            p[0] = cube(y, x, 0);
+            p[1] = cube(y, x, 1);
+            p[2] = cube(y, x, 2);
+        }
+
+    thumb_carve_vertical(height, width, new_width);
+
+    if (height > new_height && height >= 2) {
+        size_t n = std::max(height, width);
+        thumb_transpose(n);
+        thumb_carve_vertical(width, height, new_height);
+        thumb_transpose(n);
+    }
+
+    for (size_t y = 0; y < height; ++y)
+        for (size_t x = 0; x < width; ++x) {
+            const unsigned char* p = thumb_pixel(y, x);
+            cube(y, x, 0) = p[0];
+            cube(y, x, 1) = p[1];
+            cube(y, x, 2) = p[2];
+        }
+    return true;
+}
+
+
+
+
+
+//====================================================================================================
+//                    PROGRESSIVE CARVING (FAST PREVIEW, THEN EXACT)
+//====================================================================================================
+
+// Approximate carve: the energy map is computed once and then carved along with the cube
+// instead of being recomputed, so each seam costs one DP pass. If the deadline passes,
+// the remaining reduction is done with a plain resize.
+cv::Mat carve_greedy(Cube &cube, Energy &energy,
+                     size_t height, size_t width, size_t new_height, size_t new_width,
+                     std::chrono::steady_clock::time_point deadline) {
+    while (width > new_width && width >= 2 && std::chrono::steady_clock::now() < deadline) {
+        size_t* seam = find_vertical_seam(energy, height, width);
+        delete_vertical_seam_energy(energy, seam, height, width);
+        delete_vertical_seam(cube, seam, height, width);
+        delete[] seam;
+    }
+
+    while (height > new_height && height >= 2 && std::chrono::steady_clock::now() < deadline) {
+        size_t* seam = find_horizontal_seam(energy, height, width);
+        delete_horizontal_seam_energy(energy, seam, height, width);
+        delete_horizontal_seam(cube, seam, height, width);
+        delete[] seam;
+    }
+
+    // same floor as the seam loops: never below 1x1
+    new_width = std::max<size_t>(new_width, 1);
+    new_height = std::max<size_t>(new_height, 1);
+
+    cv::Mat out = cubeToMat(cube, height, width);
+    if (width > new_width || height > new_height) {
+        cv::Mat scaled;
+        cv::resize(out, scaled, cv::Size((int)std::min(width, new_width), (int)std::min(height, new_height)),
+                   0, 0, cv::INTER_AREA);
+        out = scaled;
+    }
+    return out;
+}
+
+// Decodes img into one Cube and computes its energy once. The exact stage takes over the
+// decoded Cube and energy map; only the preview works on copies.
+// - if cascade_path is non-empty, detection runs concurrently with decoding, the first
+//   energy pass and the preview; only the exact stage waits for it and merges its regions
+//   into the energy map before its first seam. The preview is therefore unprotected, so
+//   that detection time never counts against preview_budget.
+// - on_preview is called on the caller's thread with the greedy result, within about
+//   preview_budget, before this function returns
+// - the exact sequential carve runs on a worker thread and hands its result to on_refined
+//   (on that thread), always after on_preview
+// The returned future becomes ready when the worker is done; get() rethrows anything the
+// exact stage or on_refined threw. If the preview stage throws, the worker is cancelled
+// (carve_exact stops at the next seam), waited for, and the exception is rethrown.
+std::future<void> carve_progressive(const cv::Mat& img, size_t new_height, size_t new_width,
+                                    std::chrono::milliseconds preview_budget,
+                                    const std::function<void(const cv::Mat&)>& on_preview,
+                                    std::function<void(const cv::Mat&)> on_refined,
+                                    const string& cascade_path = "") {
+    auto deadline = std::chrono::steady_clock::now() + preview_budget;
+
+    std::future<std::vector<cv::Rect>> detection;
+    if (!cascade_path.empty()) detection = detect_protected_regions_async(img, cascade_path);
+
+    size_t H = img.rows, W = img.cols;
+    Cube source(H, W, 3);
+    matToCube(img, source);
+    Energy initial = dual_gradient_energy(source, H, W, 3);
+
+    // the greedy preview carves both pixels and energy, so it needs its own copies
+    Cube preview_cube(source);
+    Energy preview_energy(initial);
+
+    std::promise<void> preview_done;
+    std::future<void> preview_ready = preview_done.get_future();
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+
+    std::future<void> refine = std::async(std::launch::async,
+        [=, cube = std::move(source), energy = std::move(initial), detection = std::move(detection),
+         preview_ready = std::move(preview_ready), on_refined = std::move(on_refined)]() mutable {
+        std::unique_ptr<Energy> bias;
+        if (detection.valid()) {
+            bias.reset(new Energy(protection_bias(detection.get(), H, W)));
+            add_bias(energy, *bias, H, W);
+        }
+        size_t height = H, width = W;
+        carve_exact(cube, &energy, bias.get(), height, width, new_height, new_width, cancel.get());
+        if (*cancel) return;
+        cv::Mat out = cubeToMat(cube, height, width);
+        try {
+            preview_ready.get();
+        } catch (...) {
+            return; // preview failed; the caller rethrows its exception
+        }
+        on_refined(out);
+    });
+
+    try {
+        on_preview(carve_greedy(preview_cube, preview_energy, H, W, new_height, new_width, deadline));
+    } catch (...) {
+        *cancel = true;
+        preview_done.set_exception(std::current_exception());
+        refine.wait();
+        throw;
+    }
+    preview_done.set_value();
+
+    return refine;
+}
+
 
 
 
@@ -385,11 +885,634 @@ void show_with_horizontal_seam(const Cube& cube,
 
 
 
+//====================================================================================================
+//                    PARSING DIMENSIONS
+//====================================================================================================
+
+// Parses a non-negative decimal width/height. Rejects signs (strtoul would wrap "-5" around),
+// trailing characters and values that overflow size_t.
+bool parse_dimension(const string& text, size_t& value) {
+    if (text.empty() || !isdigit((unsigned char)text[0])) return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long n = std::strtoull(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || n > SIZE_MAX) return false;
+    value = (size_t)n;
+    return true;
+}
+
+
+
+
+
+//====================================================================================================
+//                    BENCHMARK MODE
+//====================================================================================================
+
+// ./seam_carving --bench <image> <width> <height>
+// Carves the same image through carve_generic and carve_thumbnail and reports the per-image
+// time of each, plus whether both produced identical pixels.
+int run_bench(const string& path, size_t new_width, size_t new_height) {
+    cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+    if (img.empty()) {
+        std::cerr << "Image not found\n";
+        return 1;
+    }
+    if (!fits_thumbnail(img.rows, img.cols)) {
+        std::cerr << "Image is larger than " << kThumbMax << "x" << kThumbMax << ", no thumbnail path\n";
+        return 1;
+    }
+
+    const int kRuns = 20;
+    using clock = std::chrono::steady_clock;
+
+    auto time_path = [&](auto carve, cv::Mat &out) {
+        double total_us = 0;
+        for (int run = 0; run < kRuns; ++run) {
+            Cube cube(img.rows, img.cols, 3);
+            matToCube(img, cube);
+            size_t H = img.rows, W = img.cols;
+            auto start = clock::now();
+            carve(cube, H, W, new_height, new_width);
+            total_us += std::chrono::duration<double, std::micro>(clock::now() - start).count();
+            if (run == 0) out = cubeToMat(cube, H, W);
+        }
+        return total_us / kRuns;
+    };
+
+    cv::Mat generic_out, thumb_out;
+    double generic_us = time_path(carve_generic, generic_out);
+    double thumb_us = time_path(carve_thumbnail, thumb_out);
+
+    bool same = generic_out.rows == thumb_out.rows && generic_out.cols == thumb_out.cols;
+    for (int y = 0; same && y < generic_out.rows; ++y)
+        same = std::memcmp(generic_out.ptr<cv::Vec3b>(y), thumb_out.ptr<cv::Vec3b>(y), generic_out.cols * 3) == 0;
+
+    cout << img.cols << "x" << img.rows << " -> " << thumb_out.cols << "x" << thumb_out.rows
+         << " (" << kRuns << " runs)" << endl;
+    cout << "generic:   " << generic_us << " us/image" << endl;
+    cout << "thumbnail: " << thumb_us << " us/image" << endl;
+    cout << "speedup:   " << generic_us / thumb_us << "x, outputs " << (same ? "identical" : "DIFFER") << endl;
+    return same ? 0 : 1;
+}
+
+
+
+
+
+//====================================================================================================
+//                    PROGRESSIVE MODE
+//====================================================================================================
+
+// ./seam_carving [--protect-faces] --progressive <image> <width> <height>
+// Shows and saves a quick preview (output_preview.png), then replaces it with the exact
+// carve (output.png) once the background stage finishes.
+int run_progressive(const string& path, size_t new_width, size_t new_height, const string& cascade_path) {
+    cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+    if (img.empty()) {
+        std::cerr << "Image not found\n";
+        return 1;
+    }
+
+    const char* kWin = "OpenCV Test";
+    const std::chrono::milliseconds kPreviewBudget(50);
+
+    cv::Mat refined;
+    try {
+        std::future<void> refine = carve_progressive(img, new_height, new_width, kPreviewBudget,
+            [&](const cv::Mat& preview) {
+                cout << "Preview ready: " << preview.cols << "x" << preview.rows << endl;
+                cv::imwrite("output_preview.png", preview);
+                cv::imshow(kWin, preview);
+                cv::waitKey(1);
+            },
+            [&](const cv::Mat& out) { refined = out; },   // HighGUI stays on the main thread
+            cascade_path);
+        refine.get();
+    } catch (const std::exception& e) {
+        std::cerr << "Carving failed: " << e.what() << "\n";
+        return 1;
+    }
+    cout << "Refined result ready: " << refined.cols << "x" << refined.rows << endl;
+    cv::imwrite("output.png", refined);
+    cv::imshow(kWin, refined);
+    cv::waitKey(0);
+    return 0;
+}
+
+
+
+
+
+//====================================================================================================
+//                    BATCH MODE
+//====================================================================================================
+
+// ./seam_carving --batch <manifest.csv|manifest.jsonl> [journal]
+//
+// One job per manifest entry:
+//   input, output   image paths (required); output is also the job's key in the journal
+//   width, height   target size; missing or 0 keeps that dimension
+//   mask            optional single-channel image, non-zero pixels are protected
+//   energy          "dual" (default) or "faces" (dual gradient + face protection)
+//
+// CSV needs a header row naming the columns, in any order, and no quoted fields.
+// JSONL is one flat object per line with string or number values.
+//
+// Jobs run on a pool of worker threads. Each output is written to a temp file and renamed into
+// place; the journal (default: <manifest>.journal) group-commits finished outputs, fsyncing
+// them before their records. On restart, journaled jobs are skipped.
+
+struct BatchJob {
+    string input, output;
+    size_t width = 0, height = 0;   // 0 = keep
+    string mask;
+    string energy = "dual";
+};
+
+static bool set_job_field(BatchJob& job, const string& key, const string& value) {
+    if (key == "input")       job.input = value;
+    else if (key == "output") job.output = value;
+    else if (key == "mask")   job.mask = value;
+    else if (key == "energy") job.energy = value.empty() ? "dual" : value;
+    else if (key == "width" || key == "height") {
+        size_t n = 0;
+        if (!value.empty() && !parse_dimension(value, n)) return false;
+        (key == "width" ? job.width : job.height) = n;
+    }
+    return true; // unknown columns are ignored
+}
+
+static std::vector<string> split_csv(const string& line) {
+    std::vector<string> fields;
+    std::stringstream ss(line);
+    string field;
+    while (std::getline(ss, field, ',')) {
+        size_t b = field.find_first_not_of(" \t\r");
+        size_t e = field.find_last_not_of(" \t\r");
+        fields.push_back(b == string::npos ? "" : field.substr(b, e - b + 1));
+    }
+    if (!line.empty() && line.back() == ',') fields.push_back("");
+    return fields;
+}
+
+static void append_utf8(string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += char(cp);
+    } else if (cp < 0x800) {
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    } else {
+        out += char(0xF0 | (cp >> 18));
+        out += char(0x80 | ((cp >> 12) & 0x3F));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
+
+// Minimal flat-object parser: {"key": "string" | number, ...}
+// Strings support every JSON escape, including \uXXXX and surrogate pairs (decoded to UTF-8),
+// since json.dumps escapes all non-ASCII characters by default.
+static bool parse_json_line(const string& line, BatchJob& job) {
+    size_t i = 0;
+    auto skip_ws = [&] { while (i < line.size() && isspace((unsigned char)line[i])) ++i; };
+    auto read_hex4 = [&](unsigned& cp) {
+        if (i + 4 > line.size()) return false;
+        cp = 0;
+        for (int k = 0; k < 4; ++k) {
+            char h = line[i++];
+            cp <<= 4;
+            if (h >= '0' && h <= '9')      cp |= unsigned(h - '0');
+            else if (h >= 'a' && h <= 'f') cp |= unsigned(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') cp |= unsigned(h - 'A' + 10);
+            else return false;
+        }
+        return true;
+    };
+    auto read_string = [&](string& out) {
+        if (i >= line.size() || line[i] != '"') return false;
+        ++i;
+        while (i < line.size() && line[i] != '"') {
+            char c = line[i++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (i >= line.size()) return false;
+            char e = line[i++];
+            switch (e) {
+                case '"': case '\\': case '/': out += e; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned cp;
+                    if (!read_hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        // high surrogate: must be followed by a low one
+                        unsigned low;
+                        if (i + 2 > line.size() || line[i] != '\\' || line[i + 1] != 'u') return false;
+                        i += 2;
+                        if (!read_hex4(low) || low < 0xDC00 || low > 0xDFFF) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        return false; // lone low surrogate
+                    }
+                    if (cp == 0) return false; // no NUL in paths
+                    append_utf8(out, cp);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        if (i >= line.size()) return false;
+        ++i; // closing quote
+        return true;
+    };
+
+    skip_ws();
+    if (i >= line.size() || line[i++] != '{') return false;
+    skip_ws();
+    if (i < line.size() && line[i] == '}') return true;
+
+    while (true) {
+        string key, value;
+        skip_ws();
+        if (!read_string(key)) return false;
+        skip_ws();
+        if (i >= line.size() || line[i++] != ':') return false;
+        skip_ws();
+        if (i < line.size() && line[i] == '"') {
+            if (!read_string(value)) return false;
+        } else {
+            while (i < line.size() && line[i] != ',' && line[i] != '}' && !isspace((unsigned char)line[i]))
+                value += line[i++];
+            if (value == "null") value.clear();
+        }
+        if (!set_job_field(job, key, value)) return false;
+        skip_ws();
+        if (i < line.size() && line[i] == ',') { ++i; continue; }
+        if (i < line.size() && line[i] == '}') return true;
+        return false;
+    }
+}
+
+// Malformed entries, including a repeated output path (two jobs would race on the same
+// file), are reported and skipped; returns false only if the file can't be read.
+bool read_manifest(const string& path, std::vector<BatchJob>& jobs) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    bool jsonl = path.size() >= 6 && path.compare(path.size() - 6, 6, ".jsonl") == 0;
+    std::vector<string> header;
+    std::unordered_set<string> outputs;
+    string line;
+    size_t line_number = 0;
+
+    while (std::getline(in, line)) {
+        ++line_number;
+        // UTF-8 byte order mark, as written by Excel
+        if (line_number == 1 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+
+        BatchJob job;
+        bool ok = true;
+        if (jsonl) {
+            ok = parse_json_line(line, job);
+        } else if (header.empty()) {
+            header = split_csv(line);
+            continue;
+        } else {
+            std::vector<string> fields = split_csv(line);
+            ok = fields.size() <= header.size();
+            for (size_t k = 0; ok && k < fields.size(); ++k)
+                ok = set_job_field(job, header[k], fields[k]);
+        }
+
+        if (!ok || job.input.empty() || job.output.empty()) {
+            std::cerr << path << ":" << line_number << ": malformed entry, skipped\n";
+            continue;
+        }
+        if (!outputs.insert(job.output).second) {
+            std::cerr << path << ":" << line_number << ": malformed entry (duplicate output "
+                      << job.output << "), skipped\n";
+            continue;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+static string parent_directory(const string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// Makes a rename or file creation in dir durable.
+static bool fsync_directory(const string& dir) {
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dfd < 0) return false;
+    bool ok = ::fsync(dfd) == 0;
+    ::close(dfd);
+    return ok;
+}
+
+// Append-only completion log with group commit, one "<output>\tok" line per finished job.
+// Finished outputs are queued; every sync_every of them (and on flush) the queued output
+// files and their directories are fsync'ed, then their records are written and the journal
+// is fsync'ed. So a journaled output is always durable, at a handful of fsyncs per batch
+// instead of two per image. A crash loses at most the queued completions, which are then
+// simply redone.
+class Journal {
+    int fd;
+    size_t sync_every;
+    std::vector<string> pending;   // outputs written but not yet durable
+    std::mutex lock;
+
+    // Returns the number of outputs that could not be committed.
+    size_t commit(const std::vector<string>& batch) {
+        std::unordered_set<string> dirs;
+        string records;
+        bool ok = true;
+        for (const string& output : batch) {
+            int ofd = ::open(output.c_str(), O_RDONLY);
+            ok = ofd >= 0 && ::fsync(ofd) == 0 && ok;
+            if (ofd >= 0) ::close(ofd);
+            dirs.insert(parent_directory(output));
+            records += output + "\tok\n";
+        }
+        for (const string& dir : dirs)
+            ok = fsync_directory(dir) && ok;
+
+        // O_APPEND + a single write keeps concurrent batches from interleaving
+        ok = ok && ::write(fd, records.data(), records.size()) == (ssize_t)records.size();
+        ok = ok && ::fsync(fd) == 0;
+        return ok ? 0 : batch.size();
+    }
+
+public:
+    Journal(const string& path, size_t sync_every) : sync_every(sync_every) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        // a crash can leave a torn last line; start the next record on a fresh line
+        off_t size = fd >= 0 ? ::lseek(fd, 0, SEEK_END) : 0;
+        if (size > 0) {
+            char last = '\n';
+            int rfd = ::open(path.c_str(), O_RDONLY);
+            if (rfd >= 0) {
+                if (::pread(rfd, &last, 1, size - 1) != 1) last = '\n';
+                ::close(rfd);
+            }
+            if (last != '\n' && ::write(fd, "\n", 1) != 1) { ::close(fd); fd = -1; }
+        }
+        if (fd >= 0) fsync_directory(parent_directory(path));
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    ~Journal() {
+        if (fd < 0) return;
+        flush();
+        ::close(fd);
+    }
+
+    bool ok() const { return fd >= 0; }
+
+    // Keys of finished jobs. A torn record is missing its "\tok" terminator and is dropped,
+    // even when what survived happens to be another job's output path.
+    static std::unordered_set<string> load(const string& path) {
+        const string kTerminator = "\tok";
+        std::unordered_set<string> done;
+        std::ifstream in(path);
+        string line;
+        while (std::getline(in, line)) {
+            if (line.size() > kTerminator.size() &&
+                line.compare(line.size() - kTerminator.size(), kTerminator.size(), kTerminator) == 0)
+                done.insert(line.substr(0, line.size() - kTerminator.size()));
+        }
+        return done;
+    }
+
+    // Queues a finished output (already written and renamed into place). The call that fills
+    // the queue commits it; returns the number of outputs that batch failed to commit.
+    size_t record(const string& output) {
+        std::vector<string> batch;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending.push_back(output);
+            if (pending.size() < sync_every) return 0;
+            batch.swap(pending);
+        }
+        return commit(batch);
+    }
+
+    // Commits whatever is queued; same return value as record().
+    size_t flush() {
+        std::vector<string> batch;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            batch.swap(pending);
+        }
+        return batch.empty() ? 0 : commit(batch);
+    }
+};
+
+// One classifier per pool worker, loaded on first use, so the cascade XML is parsed once
+// per thread instead of once per job. nullptr if it cannot be loaded.
+static cv::CascadeClassifier* batch_cascade() {
+    static thread_local cv::CascadeClassifier cascade;
+    static thread_local bool loaded = cascade.load(kDefaultCascade);
+    return loaded ? &cascade : nullptr;
+}
+
+// Encodes img into a unique temp file next to path (mkstemp, so concurrent writers never
+// share one) and renames it over path, so path is never seen half-written. Durability is
+// left to the journal's group commit. Errors are returned as a message, empty on success.
+static string write_output(const string& path, const cv::Mat& img) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return "no extension on " + path;
+
+    std::vector<unsigned char> bytes;
+    if (!cv::imencode(path.substr(dot), img, bytes)) return "cannot encode " + path;
+
+    string dir = parent_directory(path);
+    string base = slash == string::npos ? path : path.substr(slash + 1);
+    string tmp = dir + "/." + base + ".XXXXXX";
+    int fd = ::mkstemp(&tmp[0]);
+    if (fd < 0) return "cannot create temp file in " + dir;
+    ::fchmod(fd, 0644);   // mkstemp creates 0600
+
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + written, bytes.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += (size_t)n;
+    }
+    bool ok = written == bytes.size();
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return "cannot write " + path;
+    }
+    return "";
+}
+
+// Carves one job; errors are returned as a message, empty on success.
+// May throw (cv::Exception, bad_alloc); the batch worker turns that into the job's error.
+static string run_batch_job(const BatchJob& job) {
+    if (job.energy != "dual" && job.energy != "faces")
+        return "unknown energy mode '" + job.energy + "'";
+    if (!cv::haveImageWriter(job.output))
+        return "no image writer for " + job.output;
+
+    cv::CascadeClassifier* cascade = nullptr;
+    if (job.energy == "faces" && !(cascade = batch_cascade()))
+        return "cannot load cascade " + kDefaultCascade;
+
+    cv::Mat img = cv::imread(job.input, cv::IMREAD_COLOR);
+    if (img.empty()) return "cannot read " + job.input;
+
+    cv::Mat mask;
+    if (!job.mask.empty()) {
+        mask = cv::imread(job.mask, cv::IMREAD_GRAYSCALE);
+        if (mask.empty()) return "cannot read mask " + job.mask;
+    }
+
+    size_t H = img.rows, W = img.cols;
+    size_t new_width = job.width ? std::min(job.width, W) : W;
+    size_t new_height = job.height ? std::min(job.height, H) : H;
+
+    Cube cube(H, W, 3);
+    matToCube(img, cube);
+
+    if (!cascade && mask.empty() && fits_thumbnail(H, W)) {
+        carve_thumbnail(cube, H, W, new_height, new_width);
+    } else {
+        // detection runs inline: the pool already has one worker per core
+        Energy initial = dual_gradient_energy(cube, H, W, 3);
+        std::unique_ptr<Energy> protection;
+        if (cascade || !mask.empty()) {
+            protection.reset(new Energy(protection_bias(cascade ? detect_protected_regions(img, *cascade)
+                                                                : std::vector<cv::Rect>(), H, W)));
+            if (!mask.empty()) add_mask_bias(*protection, mask, H, W);
+            add_bias(initial, *protection, H, W);
+        }
+        carve_exact(cube, &initial, protection.get(), H, W, new_height, new_width);
+    }
+
+    return write_output(job.output, cubeToMat(cube, H, W));
+}
+
+int run_batch(const string& manifest_path, const string& journal_path) {
+    std::vector<BatchJob> jobs;
+    if (!read_manifest(manifest_path, jobs)) {
+        std::cerr << "Cannot read manifest " << manifest_path << "\n";
+        return 1;
+    }
+
+    std::unordered_set<string> done = Journal::load(journal_path);
+    std::vector<const BatchJob*> todo;
+    for (const BatchJob& job : jobs)
+        if (!done.count(job.output)) todo.push_back(&job);
+
+    const size_t kSyncEvery = 64;
+    Journal journal(journal_path, kSyncEvery);
+    if (!journal.ok()) {
+        std::cerr << "Cannot open journal " << journal_path << "\n";
+        return 1;
+    }
+
+    cout << jobs.size() << " job(s), " << jobs.size() - todo.size() << " already done, "
+         << todo.size() << " to run" << endl;
+
+    std::atomic<size_t> next(0), finished(0), failed(0), uncommitted(0);
+    std::mutex log_lock;
+
+    auto worker = [&] {
+        for (size_t k = next++; k < todo.size(); k = next++) {
+            const BatchJob& job = *todo[k];
+            string error;
+            try {
+                error = run_batch_job(job);
+            } catch (const std::exception& e) {
+                error = e.what();   // an exception escaping the thread would end the whole batch
+            }
+            if (error.empty())
+                uncommitted += journal.record(job.output);
+
+            if (error.empty()) {
+                ++finished;
+            } else {
+                ++failed;
+                std::lock_guard<std::mutex> guard(log_lock);
+                std::cerr << job.input << ": " << error << "\n";
+            }
+        }
+    };
+
+    // the pool already fills every core; keep OpenCV's own parallel_for_ from oversubscribing
+    cv::setNumThreads(1);
+
+    size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min(n_threads, std::max<size_t>(1, todo.size()));
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < n_threads; ++t) pool.emplace_back(worker);
+    for (std::thread& t : pool) t.join();
+    uncommitted += journal.flush();
+
+    cout << finished << " finished, " << failed << " failed" << endl;
+    if (uncommitted)
+        std::cerr << uncommitted << " finished job(s) could not be journaled and will rerun\n";
+    return failed || uncommitted ? 1 : 0;
+}
+
+
+
+
+
 //====================================================================================================
 //                    MAIN FUNCTION
 //====================================================================================================
 
-int main() {
+int main(int argc, char** argv) {
+    // --protect-faces applies to interactive and --progressive runs only; batch jobs choose
+    // protection per entry through their energy mode, and --bench times unprotected carving
+    std::vector<string> args(argv + 1, argv + argc);
+    string cascade_path;
+    auto protect_flag = std::find(args.begin(), args.end(), "--protect-faces");
+    if (protect_flag != args.end()) {
+        cascade_path = kDefaultCascade;
+        args.erase(protect_flag);
+        if (!args.empty() && (args[0] == "--bench" || args[0] == "--batch")) {
+            std::cerr << "--protect-faces cannot be used with " << args[0]
+                      << " (batch jobs use energy=faces instead)\n";
+            return 1;
+        }
+    }
+
+    size_t arg_width = 0, arg_height = 0;
+    if (args.size() == 4 && (args[0] == "--bench" || args[0] == "--progressive") &&
+        !(parse_dimension(args[2], arg_width) && parse_dimension(args[3], arg_height))) {
+        std::cerr << "usage: " << argv[0] << " " << args[0] << " <image> <width> <height>\n"
+                  << "width and height must be non-negative integers\n";
+        return 1;
+    }
+
+    if (args.size() == 4 && args[0] == "--bench")
+        return run_bench(args[1], arg_width, arg_height);
+    if ((args.size() == 2 || args.size() == 3) && args[0] == "--batch")
+        return run_batch(args[1], args.size() == 3 ? args[2] : args[1] + ".journal");
+    if (args.size() == 4 && args[0] == "--progressive")
+        return run_progressive(args[1], arg_width, arg_height, cascade_path);
+
     //ios_base::sync_with_stdio(0);
     //cin.tie(NULL);
     //cout.tie(NULL);
@@ -411,6 +1534,10 @@ int main() {
          // cv::imshow("OpenCV Test", img);
     }
 
+    // start face detection now so it overlaps with filling the cube and the first energy pass
+    std::future<std::vector<cv::Rect>> detection;
+    if (!cascade_path.empty()) detection = detect_protected_regions_async(img, cascade_path);
+
     // Image dimensions
     // - img.rows  → number of rows (image height)
     // - img.cols  → number of columns (image width)
@@ -456,11 +1583,21 @@ int main() {
         }
     }
 
-    Energy energy = dual_gradient_energy(cube, img.rows, img.cols, 3);
+    Energy initial_energy = dual_gradient_energy(cube, img.rows, img.cols, 3);
 
     size_t H = static_cast<size_t>(img.rows);
     size_t W = static_cast<size_t>(img.cols);
 
+    // merge detections before the first seam; the bias map is then carved with the image
+    std::unique_ptr<Energy> protection;
+    if (detection.valid()) {
+        std::vector<cv::Rect> regions = detection.get();
+        cout << "Protecting " << regions.size() << " detected region(s)" << endl;
+        protection.reset(new Energy(protection_bias(regions, H, W)));
+        add_bias(initial_energy, *protection, H, W);
+    }
+    bool first_seam = true; // initial_energy is only valid for the uncarved image
+
     const char* kWin = "OpenCV Test";
     cv::imshow(kWin, img);
     cv::waitKey(100);
@@ -469,9 +1606,11 @@ int main() {
     if (new_width  > W) new_width  = W;
 
     while (W > new_width && W >= 2) {
-    Energy energy = dual_gradient_energy(cube, H, W, 3);
+    Energy energy = first_seam ? std::move(initial_energy) : protected_energy(cube, protection.get(), H, W);
+    first_seam = false;
     const size_t* seam = find_vertical_seam(energy, H, W);   
     show_with_vertical_seam(cube, H, W, seam, kWin);         
+    if (protection) delete_vertical_seam_energy(*protection, seam, H, W);
     delete_vertical_seam(cube, seam, H, W);                  
     cv::Mat out_after = cubeToMat(cube, H, W);
     cv::imshow(kWin, out_after);
@@ -479,9 +1618,11 @@ int main() {
     }
 
     while (H > new_height && H >= 2) {
-        Energy energy = dual_gradient_energy(cube, H, W, 3);
+        Energy energy = first_seam ? std::move(initial_energy) : protected_energy(cube, protection.get(), H, W);
+        first_seam = false;
         const size_t* seam = find_horizontal_seam(energy, H, W); 
         show_with_horizontal_seam(cube, H, W, seam, kWin);       
+        if (protection) delete_horizontal_seam_energy(*protection, seam, H, W);
         delete_horizontal_seam(cube, seam, H, W);                
         cv::Mat out_after = cubeToMat(cube, H, W);
         cv::imshow(kWin, out_after);